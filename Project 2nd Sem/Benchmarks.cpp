@@ -0,0 +1,460 @@
+// Standalone benchmarks for the components of OOP_FINAL.cpp, which is compiled
+// in with its main() left out. Each subcommand times one component and
+// prints what it measured. Only "admission" needs a MySQL server.
+//
+// Usage: Benchmarks rowmapper [rows]
+//        Benchmarks render [rows]
+//        Benchmarks analytics <DataGenerator output dir>
+//        Benchmarks admission <host> <user> <password> <schema> [rate] [burst] [pairs]
+#define OOP_FINAL_NO_MAIN
+#include "OOP_FINAL.cpp"
+
+typedef chrono::steady_clock BenchClock;
+
+static double secondsSince(BenchClock::time_point start)
+{
+    return chrono::duration<double>(BenchClock::now() - start).count();
+}
+
+// In-memory stand-in for a sql::ResultSet. Getters by index go straight to
+// the cell; getters by label resolve the column the way the connector does,
+// with an upper-cased copy of the label looked up in a map.
+class SyntheticResult
+{
+public:
+    struct Text
+    {
+        string value;
+        const string& asStdString() const { return value; }
+    };
+
+private:
+    map<string, uint32_t> columnByLabel;
+    vector<vector<string>> rows;
+    size_t cursor = 0;
+
+    const string& cell(uint32_t col) const { return rows[cursor - 1][col - 1]; }
+    uint32_t findColumn(const string& label) const
+    {
+        string upper(label);
+        for (auto& c : upper)
+            c = (char)toupper((unsigned char)c);
+        return columnByLabel.at(upper);
+    }
+
+public:
+    SyntheticResult(const vector<string>& labels, vector<vector<string>> rows)
+        : rows(move(rows))
+    {
+        for (uint32_t i = 0; i < labels.size(); ++i)
+        {
+            string upper(labels[i]);
+            for (auto& c : upper)
+                c = (char)toupper((unsigned char)c);
+            columnByLabel[upper] = i + 1;
+        }
+    }
+    void rewind() { cursor = 0; }
+    size_t rowsCount() const { return rows.size(); }
+    bool next() { return cursor < rows.size() && ++cursor; }
+    int getInt(uint32_t col) const { return atoi(cell(col).c_str()); }
+    int getInt(const string& label) const { return getInt(findColumn(label)); }
+    Text getString(uint32_t col) const { return Text{ cell(col) }; }
+    Text getString(const string& label) const { return getString(findColumn(label)); }
+};
+
+// Reads the way the Database methods did before the RowMapper: one
+// lookup by column name per field per row
+static void readByName(SyntheticResult& res, vector<Database::ScheduledCourse>& result)
+{
+    while (res.next())
+    {
+        result.push_back({ res.getInt("schedule_id"),
+                          res.getString("course_code").asStdString(),
+                          res.getString("course_name").asStdString(),
+                          res.getString("department").asStdString(),
+                          res.getInt("semester"),
+                          res.getInt("faculty_id"),
+                          res.getInt("timeslot_id"),
+                          res.getString("faculty_name").asStdString(),
+                          res.getString("day_of_week").asStdString(),
+                          res.getString("start_time").asStdString(),
+                          res.getString("end_time").asStdString(),
+                          res.getString("room_id").asStdString(),
+                          res.getString("room_number").asStdString(),
+                          res.getString("building").asStdString() });
+    }
+}
+
+static int benchRowMapper(size_t rowCount)
+{
+    const vector<string> labels = { "schedule_id", "course_code", "course_name", "department", "semester",
+        "faculty_id", "faculty_name", "timeslot_id", "day_of_week", "start_time", "end_time",
+        "room_id", "room_number", "building" };
+    const char* days[] = { "Monday", "Tuesday", "Wednesday", "Thursday", "Friday" };
+    vector<vector<string>> rows;
+    rows.reserve(rowCount);
+    for (size_t i = 0; i < rowCount; ++i)
+    {
+        int slot = (int)(i % 35);
+        rows.push_back({ to_string(i + 1), "CS" + to_string(100 + i % 400) + "-" + to_string(i % 7),
+            "Object Oriented Programming " + to_string(i % 400), "Computer Science", to_string(1 + i % 8),
+            to_string(1 + i % 900), "Faculty Member " + to_string(i % 900), to_string(slot + 1),
+            days[slot / 7], "08:30:00", "10:00:00", "R" + to_string(i % 120), to_string(100 + i % 120),
+            "Academic Block " + to_string(i % 4) });
+    }
+    SyntheticResult res(labels, move(rows));
+
+    const int RUNS = 5;
+    double byName = 1e9, byIndex = 1e9;
+    size_t checksum = 0;
+    for (int run = 0; run < RUNS; ++run)
+    {
+        vector<Database::ScheduledCourse> named;
+        res.rewind();
+        auto start = BenchClock::now();
+        readByName(res, named);
+        byName = min(byName, secondsSince(start));
+
+        vector<Database::ScheduledCourse> mapped;
+        res.rewind();
+        start = BenchClock::now();
+        Database::ScheduledCourseMapper::readAll(res, mapped);
+        byIndex = min(byIndex, secondsSince(start));
+
+        checksum += named.back().building.size() + mapped.back().building.size();
+    }
+    cout << fixed << setprecision(0);
+    cout << "rowmapper: " << rowCount << " rows x " << labels.size() << " columns, best of " << RUNS << " runs\n";
+    cout << "  by name:   " << rowCount / byName << " rows/sec\n";
+    cout << "  by index:  " << rowCount / byIndex << " rows/sec\n";
+    cout << setprecision(2) << "  speedup:   " << byName / byIndex << "x (checksum " << checksum << ")\n";
+    return 0;
+}
+
+// Timetable rows as the old viewTimetable printed them: one setw insertion
+// per cell and a flushing endl per row
+static void renderWithStreams(ostream& out, const vector<vector<string>>& rows)
+{
+    out << CYAN << left << setw(10) << "Course" << setw(32) << "Name" << setw(10) << "Day"
+        << setw(12) << "Start" << setw(12) << "End" << setw(10) << "Room"
+        << setw(10) << "Bldg" << setw(20) << "Teacher" << RESET << endl;
+    for (const auto& t : rows)
+        out << setw(10) << t[0] << setw(32) << t[1] << setw(10) << t[2]
+            << setw(12) << t[3] << setw(12) << t[4] << setw(10) << t[5]
+            << setw(10) << t[6] << setw(20) << t[7] << endl;
+}
+
+static int benchRender(size_t rowCount)
+{
+#ifdef _WIN32
+    const char* nullDevice = "NUL";
+#else
+    const char* nullDevice = "/dev/null";
+#endif
+    const char* days[] = { "Monday", "Tuesday", "Wednesday", "Thursday", "Friday" };
+    vector<vector<string>> rows;
+    rows.reserve(rowCount);
+    for (size_t i = 0; i < rowCount; ++i)
+        rows.push_back({ "CS" + to_string(100 + i % 400), "Object Oriented Programming " + to_string(i % 400), days[i % 5],
+            "08:30:00", "10:00:00", to_string(100 + i % 120), "Block " + to_string(i % 4), "Faculty Member " + to_string(i % 900) });
+    // Both paths write to the null device so only formatting and writes are timed
+    ofstream sink(nullDevice, ios::binary);
+    const int RUNS = 5;
+    double streams = 1e9, renderer = 1e9;
+    for (int run = 0; run < RUNS; ++run)
+    {
+        auto start = BenchClock::now();
+        renderWithStreams(sink, rows);
+        streams = min(streams, secondsSince(start));
+
+        start = BenchClock::now();
+        TableRenderer table({ "Course", "Name", "Day", "Start", "End", "Room", "Bldg", "Teacher" });
+        for (const auto& row : rows)
+            table.addRow(row);
+        string out;
+        table.renderTo(out, true);
+        sink.write(out.data(), out.size());
+        sink.flush();
+        renderer = min(renderer, secondsSince(start));
+    }
+    cout << fixed << setprecision(1);
+    cout << "render: " << rowCount << " timetable rows to " << nullDevice << ", best of " << RUNS << " runs\n";
+    cout << "  iostream setw/endl: " << streams * 1000 << " ms\n";
+    cout << "  TableRenderer:      " << renderer * 1000 << " ms\n";
+    cout << setprecision(2) << "  speedup:            " << streams / renderer << "x\n";
+    return 0;
+}
+
+// Reads a DataGenerator CSV file row by row: header skipped, fields split on
+// the delimiter, surrounding quotes removed.
+static bool forEachCsvRow(const string& path, char delimiter, const function<void(const vector<string>&)>& visit)
+{
+    ifstream in(path);
+    if (!in)
+    {
+        cerr << "Cannot open " << path << endl;
+        return false;
+    }
+    string line;
+    getline(in, line);
+    vector<string> fields;
+    while (getline(in, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        fields.clear();
+        string field;
+        bool quoted = false;
+        for (char c : line)
+        {
+            if (c == '"')
+                quoted = !quoted;
+            else if (c == delimiter && !quoted)
+            {
+                fields.push_back(field);
+                field.clear();
+            }
+            else
+                field += c;
+        }
+        fields.push_back(field);
+        visit(fields);
+    }
+    return true;
+}
+
+static int benchAnalytics(const string& dir)
+{
+    AnalyticsSnapshot snapshot;
+    auto start = BenchClock::now();
+    {
+        AnalyticsSnapshot::Builder build(snapshot);
+        map<string, Database::SectionRow> courses; // course_code -> course columns of a section row
+        bool ok = forEachCsvRow(dir + "/classrooms.csv", ',', [&](const vector<string>& f) { build.addRoom(f[0], atoi(f[3].c_str())); })
+            && forEachCsvRow(dir + "/faculty.csv", ';', [&](const vector<string>& f) { build.addFaculty(atoi(f[0].c_str()), f[1] + " " + f[2]); })
+            && forEachCsvRow(dir + "/timeslots.csv", ',', [&](const vector<string>& f) { build.addTimeslot(atoi(f[0].c_str()), f[1] + " " + f[2] + "-" + f[3]); })
+            && forEachCsvRow(dir + "/students.csv", ',', [&](const vector<string>& f) { build.addStudent(f[0], f[4], atoi(f[5].c_str())); })
+            && forEachCsvRow(dir + "/courses.csv", ',', [&](const vector<string>& f) {
+                   auto& course = courses[f[0]];
+                   course.course_code = f[0];
+                   course.credits = atoi(f[2].c_str());
+                   course.semester = atoi(f[3].c_str());
+                   course.department = f[4];
+                   course.max_students = atoi(f[5].c_str());
+               })
+            && forEachCsvRow(dir + "/course_schedule.csv", ',', [&](const vector<string>& f) {
+                   auto row = courses[f[1]];
+                   row.schedule_id = atoi(f[0].c_str());
+                   row.faculty_id = atoi(f[2].c_str());
+                   row.timeslot_id = atoi(f[3].c_str());
+                   row.room_id = f[4];
+                   build.addSection(row);
+               })
+            && forEachCsvRow(dir + "/enrollments.csv", ',', [&](const vector<string>& f) { build.addEnrollment(f[0], atoi(f[1].c_str())); });
+        if (!ok)
+            return 1;
+    }
+    double loadSeconds = secondsSince(start);
+
+    const int RUNS = 5;
+    double computeSeconds = 1e9;
+    AnalyticsReport report(snapshot);
+    for (int run = 0; run < RUNS; ++run)
+    {
+        start = BenchClock::now();
+        report.compute();
+        computeSeconds = min(computeSeconds, secondsSince(start));
+    }
+    start = BenchClock::now();
+    report.writeCsv(dir + "/report_");
+    report.writeJson(dir + "/report.json");
+    double writeSeconds = secondsSince(start);
+
+    cout << fixed << setprecision(1);
+    cout << "analytics: " << snapshot.studentIds.size() << " students, " << snapshot.sectionScheduleId.size() << " sections, "
+        << snapshot.enrollmentSection.size() << " enrollments, " << thread::hardware_concurrency() << " hardware threads\n";
+    cout << "  load CSV into snapshot: " << loadSeconds * 1000 << " ms\n";
+    cout << "  compute (best of " << RUNS << "):  " << computeSeconds * 1000 << " ms\n";
+    cout << "  write CSV and JSON:     " << writeSeconds * 1000 << " ms\n";
+    return 0;
+}
+
+struct AdmissionConfig
+{
+    string host, user, password, schema;
+    double rate;  // requests per second the queue admits
+    size_t burst; // arrivals are burst times the rate: rate * burst clients start at once
+    size_t pairs;
+};
+
+// A student and a section they can add without a clash
+struct BenchClient
+{
+    string studentId;
+    int semester, schedule_id;
+};
+
+struct LatencyRun
+{
+    vector<double> latencies; // seconds per request
+    double seconds = 0;
+    int applied = 0;
+    long long commits = 0; // Com_commit on the server during the run
+};
+
+static vector<BenchClient> pickClients(Database& db, size_t wanted)
+{
+    map<pair<string, int>, vector<int>> sections; // (department, semester) -> schedule ids
+    map<int, int> timeslots;
+    for (const auto& row : db.getSectionRows())
+    {
+        sections[make_pair(row.department, row.semester)].push_back(row.schedule_id);
+        timeslots[row.schedule_id] = row.timeslot_id;
+    }
+    vector<tuple<string, string, int>> students;
+    db.forEachStudent([&](const string& id, const string& degree, int semester) {
+        if (students.size() < wanted * 4)
+            students.emplace_back(id, degree, semester);
+    });
+    vector<BenchClient> clients;
+    for (const auto& student : students)
+    {
+        if (clients.size() == wanted)
+            break;
+        for (int schedule_id : sections[make_pair(get<1>(student), get<2>(student))])
+            if (!db.isAlreadyEnrolled(get<0>(student), schedule_id) && !db.hasClash(get<0>(student), timeslots[schedule_id]))
+            {
+                clients.push_back({ get<0>(student), get<2>(student), schedule_id });
+                break;
+            }
+    }
+    return clients;
+}
+
+// Every client opens its own connection, as a separate program would, and
+// all start together. Direct mode commits each request on its own through
+// applyEnrollmentChanges; queued mode goes through the shared admission
+// queue, which commits whatever is pending as one group. Each pair is an add followed by the drop of the same
+// section, so the data ends as it started.
+static LatencyRun runBurst(const AdmissionConfig& config, const vector<BenchClient>& clients, bool queued)
+{
+    LatencyRun run;
+    mutex merge;
+    atomic<size_t> ready(0);
+    atomic<bool> go(false);
+    vector<thread> threads;
+    for (const auto& client : clients)
+        threads.emplace_back([&, client] {
+            vector<double> mine;
+            int applied = 0;
+            try
+            {
+                Database db(config.host, config.user, config.password, config.schema);
+                AdmissionQueue admission(db, numeric_limits<size_t>::max(), config.rate, (size_t)config.rate, 25);
+                ++ready;
+                while (!go)
+                    this_thread::yield();
+                for (size_t i = 0; i < config.pairs; ++i)
+                    for (bool drop : { false, true })
+                    {
+                        auto start = BenchClock::now();
+                        bool ok;
+                        if (queued)
+                        {
+                            auto ticket = drop ? admission.submitDrop(client.studentId, client.semester, client.schedule_id)
+                                               : admission.submit(client.studentId, client.semester, client.schedule_id);
+                            ok = ticket.admitted && ticket.result.get();
+                        }
+                        else
+                            ok = db.applyEnrollmentChanges({ { client.studentId, client.schedule_id, drop } })[0];
+                        mine.push_back(secondsSince(start));
+                        applied += ok ? 1 : 0;
+                        if (!ok)
+                            break; // no drop without the add
+                    }
+            }
+            catch (exception& ex)
+            {
+                ++ready;
+                cerr << "client " << client.studentId << ": " << ex.what() << endl;
+            }
+            lock_guard<mutex> guard(merge);
+            run.latencies.insert(run.latencies.end(), mine.begin(), mine.end());
+            run.applied += applied;
+        });
+    while (ready < clients.size())
+        this_thread::yield();
+    auto start = BenchClock::now();
+    go = true;
+    for (auto& t : threads)
+        t.join();
+    run.seconds = secondsSince(start);
+    return run;
+}
+
+static double percentile(const vector<double>& sorted, double p)
+{
+    return sorted.empty() ? 0 : sorted[min(sorted.size() - 1, (size_t)(p * sorted.size()))];
+}
+
+static void printRun(const string& label, LatencyRun& run)
+{
+    sort(run.latencies.begin(), run.latencies.end());
+    cout << fixed << setprecision(2);
+    cout << "  " << label << ": " << run.latencies.size() << " requests in " << run.seconds << "s, "
+        << run.latencies.size() / run.seconds << " req/s, " << run.applied << " applied\n";
+    cout << "    " << run.commits << " commits, " << run.commits / run.seconds << " commits/s, "
+        << (run.commits ? (double)run.latencies.size() / run.commits : 0.0) << " requests per commit\n";
+    cout << "    latency ms  p50 " << percentile(run.latencies, 0.50) * 1000 << "  p95 " << percentile(run.latencies, 0.95) * 1000
+        << "  p99 " << percentile(run.latencies, 0.99) * 1000 << "  max " << (run.latencies.empty() ? 0 : run.latencies.back() * 1000) << "\n";
+}
+
+static int benchAdmission(const AdmissionConfig& config)
+{
+    Database db(config.host, config.user, config.password, config.schema);
+    auto clients = pickClients(db, (size_t)ceil(config.rate * config.burst));
+    if (clients.empty())
+    {
+        cerr << "No student has a section left to add.\n";
+        return 1;
+    }
+    cout << "admission: " << clients.size() << " clients arriving at once (" << config.burst << "x the queue rate of "
+        << config.rate << "/s), " << config.pairs << " add/drop pairs each\n";
+    if (clients.size() < config.rate * config.burst)
+        cout << "  only " << clients.size() << " students have a section left to add, so the burst is smaller\n";
+    // Commits are counted server-wide, so the server should be otherwise idle
+    long long commits = db.getGlobalStatus("Com_commit");
+    auto direct = runBurst(config, clients, false);
+    direct.commits = db.getGlobalStatus("Com_commit") - commits;
+    printRun("direct", direct);
+    commits = db.getGlobalStatus("Com_commit");
+    auto queued = runBurst(config, clients, true);
+    queued.commits = db.getGlobalStatus("Com_commit") - commits;
+    printRun("queued", queued);
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    string command = argc > 1 ? argv[1] : "";
+    if (command == "rowmapper")
+        return benchRowMapper(argc > 2 ? strtoull(argv[2], nullptr, 10) : 200000);
+    if (command == "render")
+        return benchRender(argc > 2 ? strtoull(argv[2], nullptr, 10) : 100000);
+    if (command == "analytics" && argc > 2)
+        return benchAnalytics(argv[2]);
+    if (command == "admission" && argc > 5)
+    {
+        AdmissionConfig config = { argv[2], argv[3], argv[4], argv[5],
+            argc > 6 ? atof(argv[6]) : 50.0,
+            argc > 7 ? strtoull(argv[7], nullptr, 10) : 10,
+            argc > 8 ? strtoull(argv[8], nullptr, 10) : 10 };
+        return benchAdmission(config);
+    }
+    cerr << "Usage: " << argv[0] << " rowmapper [rows]\n"
+        << "       " << argv[0] << " render [rows]\n"
+        << "       " << argv[0] << " analytics <DataGenerator output dir>\n"
+        << "       " << argv[0] << " admission <host> <user> <password> <schema> [rate] [burst] [pairs]\n";
+    return 1;
+}
@@ -0,0 +1,418 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cstdlib>
+
+using namespace std;
+
+// Seeded generator for production-sized datasets in the same CSV formats as
+// Data/ (plus course_schedule.csv and enrollments.csv). Rows are streamed to
+// disk as they are produced; the only state kept is per department/semester
+// group and per timeslot, so memory stays flat however many students are
+// requested. The same seed and size always produce byte-identical files.
+//
+// Usage: DataGenerator <students> [seed] [output dir]
+
+struct Subject
+{
+    int semester;
+    string number; // e.g. "202", "202L"
+    string name;
+    int credits;
+};
+
+struct Department
+{
+    string name, prefix;
+    int weight; // share of students, from Data/students.csv
+    vector<Subject> subjects;
+};
+
+struct GeneralCourse
+{
+    int semester;
+    string code, name;
+    int credits;
+    vector<string> departments;
+};
+
+// One department/semester cohort; every course in it gets the same number
+// of sections so that a student in section j of each course never clashes.
+struct Group
+{
+    int department, semester;
+    long long students = 0;
+    long long sections = 0;
+    vector<string> courseCodes; // without section suffix
+    vector<bool> courseIsLab;
+    long long firstScheduleId = 0;
+    int slotBase = 0;
+};
+
+class DataGenerator
+{
+    enum { DAYS = 5, SLOTS_PER_DAY = 7, TIMESLOTS = DAYS * SLOTS_PER_DAY };
+    enum { SECTION_SIZE = 50, LAB_SIZE = 75, LAB_ROOM_CAPACITY = 75, SECTIONS_PER_FACULTY = 4 };
+
+    long long studentCount;
+    unsigned long long seed;
+    string outDir;
+    vector<Department> departments;
+    vector<GeneralCourse> general;
+    vector<int> semesters = { 2, 4, 6, 8 };
+    vector<int> semesterWeights = { 40, 30, 20, 10 }; // from Data/students.csv
+    vector<Group> groups;
+
+    // mt19937_64 output is fixed by the standard; the distributions are not,
+    // so draws are reduced by hand to stay identical across compilers.
+    static size_t pick(mt19937_64& rng, size_t n) { return (size_t)(rng() % n); }
+    static size_t pickWeighted(mt19937_64& rng, const vector<int>& weights)
+    {
+        int total = 0;
+        for (int w : weights)
+            total += w;
+        long long roll = (long long)(rng() % (unsigned long long)total);
+        for (size_t i = 0; i < weights.size(); ++i)
+        {
+            roll -= weights[i];
+            if (roll < 0)
+                return i;
+        }
+        return weights.size() - 1;
+    }
+    // A..Z like Data/courses.csv, then -27, -28, ... so that a lettered
+    // suffix can never collide with a lab code (CS202 + "LA" vs CS202L + "A")
+    static string sectionSuffix(long long index)
+    {
+        return index < 26 ? string(1, (char)('A' + index)) : "-" + to_string(index + 1);
+    }
+    static string padded(long long value, size_t width)
+    {
+        string text = to_string(value);
+        return text.size() < width ? string(width - text.size(), '0') + text : text;
+    }
+    static string lower(string text)
+    {
+        for (auto& c : text)
+            c = (char)tolower((unsigned char)c);
+        return text;
+    }
+    string path(const string& file) const { return outDir + "/" + file; }
+    ofstream open(const string& file)
+    {
+        ofstream out(path(file), ios::binary);
+        if (!out)
+        {
+            cerr << "Cannot write " << path(file) << endl;
+            exit(1);
+        }
+        return out;
+    }
+    size_t groupIndex(int department, int semester) const
+    {
+        return department * semesters.size() + (find(semesters.begin(), semesters.end(), semester) - semesters.begin());
+    }
+    // Replays the group/year draw for student i; both student passes share it
+    void drawStudent(mt19937_64& rng, int& department, int& semester)
+    {
+        vector<int> weights;
+        for (const auto& d : departments)
+            weights.push_back(d.weight);
+        department = (int)pickWeighted(rng, weights);
+        semester = semesters[pickWeighted(rng, semesterWeights)];
+    }
+    static int intakeYear(int semester) { return 2025 - semester / 2; }
+
+    void setupCatalog()
+    {
+        departments = {
+            { "Computer Science", "CS", 306, {
+                { 2, "202", "Object-Oriented Programming", 3 }, { 2, "202L", "Object-Oriented Programming Lab", 1 },
+                { 2, "203", "Multivariable Calculus", 3 }, { 2, "204", "Digital Logic Design", 2 },
+                { 2, "204L", "Digital Logic Design Lab", 1 },
+                { 4, "402", "Data Structure and Algorithms", 3 }, { 4, "403", "Operating Systems", 3 },
+                { 4, "403L", "Operating Systems Lab", 1 },
+                { 6, "602", "Artificial Intelligence", 3 }, { 6, "602L", "Artificial Intelligence Lab", 1 },
+                { 6, "603", "Computer Networks", 3 }, { 6, "603L", "Computer Networks Lab", 1 },
+                { 8, "802", "Final Year Project - II", 4 }, { 8, "803", "Entrepreneurship", 2 } } },
+            { "Software Engineering", "SE", 356, {
+                { 2, "202", "Object-Oriented Programming", 3 }, { 2, "202L", "Object-Oriented Programming Lab", 1 },
+                { 2, "203", "Multivariable Calculus", 3 }, { 2, "204", "Digital Logic Design", 2 },
+                { 2, "204L", "Digital Logic Design Lab", 1 },
+                { 4, "402", "Human-Computer Interaction", 2 }, { 4, "403", "Software Requirements Engineering", 3 },
+                { 6, "602", "Agile Software Development", 2 }, { 6, "602L", "Agile Software Development Lab", 1 },
+                { 6, "603", "Software Security", 2 },
+                { 8, "802", "Final Year Project - II", 4 }, { 8, "803", "Professional Ethics", 2 } } },
+            { "Management Business Computing", "MBC", 338, {
+                { 2, "202", "Financial Accounting", 3 }, { 2, "203", "Maths for IT", 2 },
+                { 4, "402", "Business Studies", 2 }, { 4, "403", "Database Concepts", 3 },
+                { 4, "403L", "Database Concepts Lab", 1 },
+                { 6, "602", "Professional Development", 2 }, { 6, "603", "Organizational Behavior", 3 },
+                { 8, "802", "Entrepreneurship and Innovation", 2 }, { 8, "803", "Taxation", 3 } } }
+        };
+        general = {
+            { 2, "GEN105", "Ideology and Constitution of Pakistan", 2, { "Computer Science", "Software Engineering", "Management Business Computing" } },
+            { 4, "GEN106", "Islamic Studies", 2, { "Computer Science", "Software Engineering", "Management Business Computing" } },
+            { 4, "GEN107", "Liberal Arts", 3, { "Computer Science", "Software Engineering" } }
+        };
+    }
+
+    void writeStudents()
+    {
+        static const vector<string> firstNames = { "Junaid", "Maha", "Amina", "Fatima", "Osama", "Ali", "Hassan", "Laiba",
+            "Noman", "Sana", "Umair", "Rabia", "Usman", "Saad", "Ayesha", "Bilal", "Hira", "Zain", "Mariam", "Hamza" };
+        static const vector<string> lastNames = { "Khan", "Malik", "Zahid", "Qureshi", "Rafiq", "Mehmood", "Rana", "Sheikh",
+            "Anwar", "Ali", "Farooq", "Mirza", "Butt", "Chaudhry", "Iqbal", "Siddiqui", "Javed", "Aslam" };
+        groups.assign(departments.size() * semesters.size(), Group());
+        for (size_t d = 0; d < departments.size(); ++d)
+            for (int sem : semesters)
+            {
+                auto& g = groups[groupIndex((int)d, sem)];
+                g.department = (int)d;
+                g.semester = sem;
+            }
+        mt19937_64 groupRng(seed), nameRng(seed ^ 0x9e3779b97f4a7c15ULL);
+        size_t width = max<size_t>(3, to_string(studentCount - 1).size());
+        vector<long long> perYear(semesters.size(), 0);
+        auto out = open("students.csv");
+        out << "student_id,first_name,last_name,email,degree,semester\n";
+        for (long long i = 0; i < studentCount; ++i)
+        {
+            int d, sem;
+            drawStudent(groupRng, d, sem);
+            ++groups[groupIndex(d, sem)].students;
+            size_t s = find(semesters.begin(), semesters.end(), sem) - semesters.begin();
+            string id = "F" + to_string(intakeYear(sem)) + "-" + padded(++perYear[s], width);
+            out << id << "," << firstNames[pick(nameRng, firstNames.size())] << "," << lastNames[pick(nameRng, lastNames.size())]
+                << "," << lower(id) << "@bnu.edu.pk," << departments[d].name << "," << sem << "\n";
+        }
+    }
+
+    void writeCourses()
+    {
+        auto out = open("courses.csv");
+        out << "\xEF\xBB\xBF" << "course_code,course_name,credits,semester,department,max_students,prerequisites\n"; // BOM as in Data/courses.csv
+        vector<long long> generalSections(general.size(), 0); // GEN section letters run on across departments
+        for (auto& g : groups)
+        {
+            const auto& dept = departments[g.department];
+            g.sections = max<long long>(1, (g.students + SECTION_SIZE - 1) / SECTION_SIZE);
+            auto emit = [&](const string& code, const string& name, int credits, int capacity, const string& prereq, long long firstSuffix, bool alwaysSuffix) {
+                g.courseCodes.push_back(code);
+                g.courseIsLab.push_back(name.find("Lab") != string::npos);
+                for (long long j = 0; j < g.sections; ++j)
+                {
+                    string suffix = (g.sections > 1 || alwaysSuffix) ? sectionSuffix(firstSuffix + j) : "";
+                    out << code << suffix << "," << name << (suffix.empty() ? "" : " (" + suffix + ")") << "," << credits << ","
+                        << g.semester << "," << dept.name << "," << capacity << "," << prereq << "\n";
+                }
+            };
+            for (const auto& subject : dept.subjects)
+                if (subject.semester == g.semester)
+                {
+                    bool lab = subject.name.find("Lab") != string::npos;
+                    string prereq = dept.prefix + to_string(g.semester - 1) + subject.number.substr(1);
+                    emit(dept.prefix + subject.number, subject.name, subject.credits, lab ? LAB_SIZE : SECTION_SIZE, prereq, 0, false);
+                }
+            for (size_t k = 0; k < general.size(); ++k)
+                if (general[k].semester == g.semester &&
+                    find(general[k].departments.begin(), general[k].departments.end(), dept.name) != general[k].departments.end())
+                {
+                    emit(general[k].code, general[k].name, general[k].credits, SECTION_SIZE, "", generalSections[k], true);
+                    generalSections[k] += g.sections;
+                }
+        }
+    }
+
+    string sectionCode(const Group& g, size_t course, long long section, const vector<long long>& generalBase) const
+    {
+        const string& code = g.courseCodes[course];
+        for (size_t k = 0; k < general.size(); ++k)
+            if (general[k].code == code)
+                return code + sectionSuffix(generalBase[groupIndex(g.department, g.semester) * general.size() + k] + section);
+        return g.sections > 1 ? code + sectionSuffix(section) : code;
+    }
+
+    void writeTimeslots()
+    {
+        static const char* days[DAYS] = { "Monday", "Tuesday", "Wednesday", "Thursday", "Friday" };
+        auto out = open("timeslots.csv");
+        out << "timeslot_id,day_of_week,start_time,end_time\n";
+        for (int d = 0; d < DAYS; ++d)
+            for (int s = 0; s < SLOTS_PER_DAY; ++s)
+            {
+                int start = 8 * 60 + s * 90, end = start + 90;
+                out << d * SLOTS_PER_DAY + s + 1 << "," << days[d] << "," << padded(start / 60, 2) << ":" << padded(start % 60, 2)
+                    << ":00," << padded(end / 60, 2) << ":" << padded(end % 60, 2) << ":00\n";
+            }
+    }
+
+    // Section j of course c in a group sits in slot (base + c + C*j) mod 35, so
+    // the C courses a student takes in section j always land in distinct slots.
+    int slotOf(const Group& g, size_t course, long long section) const
+    {
+        long long courses = (long long)g.courseCodes.size();
+        return (int)((g.slotBase + (long long)course + courses * section) % TIMESLOTS);
+    }
+
+    void writeSchedules()
+    {
+        // GEN suffix bases per (group, general course), matching writeCourses
+        vector<long long> generalBase(groups.size() * general.size(), 0), generalRunning(general.size(), 0);
+        vector<long long> lectureUse(TIMESLOTS, 0), labUse(TIMESLOTS, 0), sectionsAt(TIMESLOTS, 0);
+        long long totalSections = 0;
+        for (size_t gi = 0; gi < groups.size(); ++gi)
+        {
+            auto& g = groups[gi];
+            g.slotBase = (int)(gi * SLOTS_PER_DAY % TIMESLOTS);
+            for (size_t k = 0; k < general.size(); ++k)
+                if (find(g.courseCodes.begin(), g.courseCodes.end(), general[k].code) != g.courseCodes.end())
+                {
+                    generalBase[gi * general.size() + k] = generalRunning[k];
+                    generalRunning[k] += g.sections;
+                }
+            for (size_t c = 0; c < g.courseCodes.size(); ++c)
+                for (long long j = 0; j < g.sections; ++j)
+                {
+                    int slot = slotOf(g, c, j);
+                    ++(g.courseIsLab[c] ? labUse : lectureUse)[slot];
+                    ++sectionsAt[slot];
+                    ++totalSections;
+                }
+        }
+        long long labRooms = *max_element(labUse.begin(), labUse.end());
+        long long lectureRooms = *max_element(lectureUse.begin(), lectureUse.end());
+        long long faculty = max(*max_element(sectionsAt.begin(), sectionsAt.end()),
+            (totalSections + SECTIONS_PER_FACULTY - 1) / SECTIONS_PER_FACULTY);
+
+        size_t roomWidth = max<size_t>(3, to_string(labRooms + lectureRooms).size());
+        auto roomId = [&](bool lab, long long index) { return "R_" + padded((lab ? 0 : labRooms) + index + 1, roomWidth); };
+
+        auto out = open("course_schedule.csv");
+        out << "schedule_id,course_code,faculty_id,timeslot_id,room_id\n";
+        fill(labUse.begin(), labUse.end(), 0);
+        fill(lectureUse.begin(), lectureUse.end(), 0);
+        fill(sectionsAt.begin(), sectionsAt.end(), 0);
+        long long scheduleId = 0;
+        for (auto& g : groups)
+        {
+            g.firstScheduleId = scheduleId + 1;
+            for (size_t c = 0; c < g.courseCodes.size(); ++c)
+                for (long long j = 0; j < g.sections; ++j)
+                {
+                    int slot = slotOf(g, c, j);
+                    bool lab = g.courseIsLab[c];
+                    long long room = (lab ? labUse : lectureUse)[slot]++;
+                    // Each slot starts at its own band of faculty so load spreads evenly
+                    long long teacher = (slot * ((faculty + TIMESLOTS - 1) / TIMESLOTS) + sectionsAt[slot]++) % faculty;
+                    out << ++scheduleId << "," << sectionCode(g, c, j, generalBase) << "," << teacher + 1 << ","
+                        << slot + 1 << "," << roomId(lab, room) << "\n";
+                }
+        }
+        writeClassrooms(labRooms, lectureRooms, roomWidth);
+        writeFaculty(faculty);
+    }
+
+    void writeClassrooms(long long labRooms, long long lectureRooms, size_t width)
+    {
+        static const int lectureCapacities[] = { 55, 70, 100, 150, 200 };
+        static const char* lectureBuildings[] = { "SLASS", "SB" };
+        auto out = open("classrooms.csv");
+        out << "\xEF\xBB\xBF" << "room_id,building,room_number,capacity,room_type\n"; // BOM as in Data/classrooms.csv
+        for (long long r = 0; r < labRooms; ++r)
+            out << "R_" << padded(r + 1, width) << ",SCIT," << 100 + r << "," << LAB_ROOM_CAPACITY << ",Lab\n";
+        for (long long r = 0; r < lectureRooms; ++r)
+        {
+            int capacity = lectureCapacities[r % 5];
+            out << "R_" << padded(labRooms + r + 1, width) << "," << lectureBuildings[r % 2] << "," << 100 + r / 2 << ","
+                << capacity << "," << (capacity >= 150 ? "Auditorium" : "Lecture") << "\n";
+        }
+    }
+
+    void writeFaculty(long long count)
+    {
+        static const vector<string> firstNames = { "Shafaat", "Shahid", "Ayesha", "Imran", "Sadia", "Kamran", "Nadia", "Tariq",
+            "Saima", "Faisal", "Rizwan", "Uzma", "Adeel", "Farah", "Waqas", "Sobia" };
+        static const vector<string> lastNames = { "Bazaz", "Iqbal", "Ahmed", "Hussain", "Raza", "Nawaz", "Akhtar", "Saleem",
+            "Haider", "Rehman", "Abbas", "Shah", "Yousaf", "Naqvi" };
+        static const vector<string> degrees = { "Computer Science", "Data Science", "Information Systems", "Information Technology",
+            "Software Engineering", "Mathematics" };
+        static const vector<string> qualifications = { "PhD", "MPhil", "MS", "MSc", "BS" };
+        static const vector<string> expertise = { "Computer Architecture", "Database Systems", "Machine Learning", "Computer Networks",
+            "Data Science", "Programming Languages", "Artificial Intelligence", "Cybersecurity", "Web Development", "Data Structures",
+            "Software Testing", "Cloud Computing", "Computer Graphics", "Big Data Analytics", "Human-Computer Interaction",
+            "Agile Development", "Business Intelligence", "Multivariable Calculus" };
+        static const vector<string> designations = { "Professor", "Lecturer", "Lecturer", "Lecturer", "Lab Attender" };
+        mt19937_64 rng(seed ^ 0xfac017ULL);
+        auto out = open("faculty.csv");
+        out << "\"faculty_id\";\"first_name\";\"last_name\";\"email\";\"degree\";\"qualification\";\"expertise_sub\";\"designation\"\n";
+        for (long long f = 1; f <= count; ++f)
+        {
+            const string& first = firstNames[pick(rng, firstNames.size())];
+            const string& last = lastNames[pick(rng, lastNames.size())];
+            out << f << ";\"" << first << "\";\"" << last << "\";\"" << lower(first) << "." << lower(last) << f << "@bnu.edu.pk\";\""
+                << degrees[pick(rng, degrees.size())] << "\";\"" << qualifications[pick(rng, qualifications.size())] << "\";\""
+                << expertise[pick(rng, expertise.size())] << "\";\"" << designations[pick(rng, designations.size())] << "\"\n";
+        }
+    }
+
+    // Second pass over the student stream: the k-th student of a group takes
+    // section k mod S of every course in the group.
+    void writeEnrollments()
+    {
+        mt19937_64 groupRng(seed);
+        size_t width = max<size_t>(3, to_string(studentCount - 1).size());
+        vector<long long> perYear(semesters.size(), 0), seen(groups.size(), 0);
+        auto out = open("enrollments.csv");
+        out << "student_id,schedule_id\n";
+        for (long long i = 0; i < studentCount; ++i)
+        {
+            int d, sem;
+            drawStudent(groupRng, d, sem);
+            size_t s = find(semesters.begin(), semesters.end(), sem) - semesters.begin();
+            string id = "F" + to_string(intakeYear(sem)) + "-" + padded(++perYear[s], width);
+            const auto& g = groups[groupIndex(d, sem)];
+            long long section = seen[groupIndex(d, sem)]++ % g.sections;
+            for (size_t c = 0; c < g.courseCodes.size(); ++c)
+                out << id << "," << g.firstScheduleId + (long long)c * g.sections + section << "\n";
+        }
+    }
+
+public:
+    DataGenerator(long long studentCount, unsigned long long seed, const string& outDir)
+        : studentCount(studentCount), seed(seed), outDir(outDir)
+    {
+        setupCatalog();
+    }
+    void run()
+    {
+        writeStudents();
+        writeCourses();
+        writeTimeslots();
+        writeSchedules();
+        writeEnrollments();
+    }
+};
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        cerr << "Usage: " << argv[0] << " <students> [seed] [output dir]\n";
+        return 1;
+    }
+    long long students = atoll(argv[1]);
+    unsigned long long seed = argc > 2 ? strtoull(argv[2], nullptr, 10) : 2024;
+    string outDir = argc > 3 ? argv[3] : ".";
+    if (students <= 0)
+    {
+        cerr << "Student count must be positive.\n";
+        return 1;
+    }
+    DataGenerator(students, seed, outDir).run();
+    cout << "Generated dataset for " << students << " students (seed " << seed << ") in " << outDir << endl;
+    return 0;
+}